@@ -0,0 +1,442 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <arpa/inet.h>
+#include "filterRules.h"
+
+#define MAX_RULE_SIZE 2048
+#define INITIAL_SLOTS 1024
+
+// decision of the host rules for a host
+#define HOST_DECISION_NONE 0
+#define HOST_DECISION_BLOCK 1
+#define HOST_DECISION_ALLOW 2
+
+// errors of add_host_rule
+#define RULE_INVALID -1
+#define RULE_NO_MEMORY -2
+
+/**
+ * an entry of the per thread decision cache
+ */
+typedef struct decision_entry_st {
+    unsigned long generation;   //rule set the decision was made with, 0 if the entry is free
+    unsigned long hash;         //hash of the host
+    int decision;               //HOST_DECISION_*
+    char host[DECISION_CACHE_HOST_SIZE];
+} decision_entry;
+
+static __thread decision_entry decision_cache[DECISION_CACHE_SIZE];
+
+// Every loaded rule set gets a new generation, so cached decisions of freed rules are never used
+static unsigned long next_generation = 0;
+
+// FNV-1a hash of "length" bytes
+static unsigned long hash_bytes(const char* bytes, size_t length) {
+    unsigned long hash = 2166136261UL;
+    for (size_t i = 0; i < length; ++i) {
+        hash ^= (unsigned char)bytes[i];
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+static unsigned int slot_of(const filterRules* rules, unsigned int parent, const char* label, size_t length) {
+    unsigned long hash = hash_bytes(label, length) ^ (parent * 2654435761UL);
+    return (unsigned int)(hash & (rules->num_slots - 1));
+}
+
+// Find the child of "parent" with the given label, returns 0 if there is none
+static unsigned int find_child(const filterRules* rules, unsigned int parent, const char* label, size_t length) {
+    unsigned int slot = slot_of(rules, parent, label, length);
+    // Linear probing until an empty slot
+    while (rules->slots[slot] != 0) {
+        const host_node* node = &rules->nodes[rules->slots[slot]];
+        const char* node_label = rules->labels + node->label;
+        if (node->parent == parent && strncmp(node_label, label, length) == 0 && node_label[length] == '\0') {
+            return rules->slots[slot];
+        }
+        slot = (slot + 1) & (rules->num_slots - 1);
+    }
+    return 0;
+}
+
+// Double the hash table and insert all the nodes again
+static int grow_slots(filterRules* rules) {
+    unsigned int* old_slots = rules->slots;
+    unsigned int num_slots = rules->num_slots * 2;
+    unsigned int* slots = (unsigned int*)calloc(num_slots, sizeof(unsigned int));
+    if (slots == NULL) {
+        perror("calloc\n");
+        return -1;
+    }
+    rules->slots = slots;
+    rules->num_slots = num_slots;
+
+    for (unsigned int i = 1; i < rules->num_nodes; ++i) {
+        const char* label = rules->labels + rules->nodes[i].label;
+        unsigned int slot = slot_of(rules, rules->nodes[i].parent, label, strlen(label));
+        while (rules->slots[slot] != 0) {
+            slot = (slot + 1) & (rules->num_slots - 1);
+        }
+        rules->slots[slot] = i;
+    }
+    free(old_slots);
+    return 0;
+}
+
+// Add a child to "parent" with the given label, returns its index or 0 on failure
+static unsigned int add_child(filterRules* rules, unsigned int parent, const char* label, size_t length) {
+    // Keep the hash table at most 70% full
+    if ((rules->num_nodes + 1) * 10 > rules->num_slots * 7 && grow_slots(rules) != 0) {
+        return 0;
+    }
+
+    if (rules->num_nodes == rules->nodes_capacity) {
+        unsigned int capacity = rules->nodes_capacity * 2;
+        host_node* nodes = (host_node*)realloc(rules->nodes, capacity * sizeof(host_node));
+        if (nodes == NULL) {
+            perror("realloc\n");
+            return 0;
+        }
+        rules->nodes = nodes;
+        rules->nodes_capacity = capacity;
+    }
+
+    while (rules->labels_size + length + 1 > rules->labels_capacity) {
+        size_t capacity = rules->labels_capacity * 2;
+        char* labels = (char*)realloc(rules->labels, capacity);
+        if (labels == NULL) {
+            perror("realloc\n");
+            return 0;
+        }
+        rules->labels = labels;
+        rules->labels_capacity = capacity;
+    }
+
+    // Store the label in the arena
+    memcpy(rules->labels + rules->labels_size, label, length);
+    rules->labels[rules->labels_size + length] = '\0';
+
+    unsigned int index = rules->num_nodes++;
+    rules->nodes[index].parent = parent;
+    rules->nodes[index].label = (unsigned int)rules->labels_size;
+    rules->nodes[index].flags = 0;
+    rules->labels_size += length + 1;
+
+    unsigned int slot = slot_of(rules, parent, label, length);
+    while (rules->slots[slot] != 0) {
+        slot = (slot + 1) & (rules->num_slots - 1);
+    }
+    rules->slots[slot] = index;
+
+    return index;
+}
+
+// Lower case the host and drop a trailing dot, returns the length or -1 if it does not fit
+static int normalize_host(const char* host, char* normalized, size_t size) {
+    size_t length = strlen(host);
+    if (length > 0 && host[length - 1] == '.') {
+        length--;
+    }
+    if (length >= size) {
+        return -1;
+    }
+    for (size_t i = 0; i < length; ++i) {
+        normalized[i] = (char)tolower((unsigned char)host[i]);
+    }
+    normalized[length] = '\0';
+    return (int)length;
+}
+
+// Insert a host rule into the trie, label by label from the last one.
+// returns 0 on success, RULE_INVALID for a malformed rule, RULE_NO_MEMORY if the trie can't grow
+static int add_host_rule(filterRules* rules, const char* pattern, int allow) {
+    unsigned char flags;
+    if (strncmp(pattern, "*.", 2) == 0) {
+        flags = allow ? HOST_RULE_ALLOW_SUBDOMAINS : HOST_RULE_BLOCK_SUBDOMAINS;
+        pattern += 2;
+    }
+    else if (pattern[0] == '.') {
+        flags = allow ? HOST_RULE_ALLOW | HOST_RULE_ALLOW_SUBDOMAINS : HOST_RULE_BLOCK | HOST_RULE_BLOCK_SUBDOMAINS;
+        pattern += 1;
+    }
+    else {
+        flags = allow ? HOST_RULE_ALLOW : HOST_RULE_BLOCK;
+    }
+
+    char host[MAX_RULE_SIZE];
+    int length = normalize_host(pattern, host, sizeof(host));
+    if (length <= 0 || host[0] == '.') {
+        return RULE_INVALID;
+    }
+
+    unsigned int node = 0;
+    int end = length;
+    while (end > 0) {
+        int start = end;
+        while (start > 0 && host[start - 1] != '.') {
+            start--;
+        }
+        // An empty label, "a..b"
+        if (start == end) {
+            return RULE_INVALID;
+        }
+
+        unsigned int child = find_child(rules, node, host + start, end - start);
+        if (child == 0) {
+            child = add_child(rules, node, host + start, end - start);
+            if (child == 0) {
+                return RULE_NO_MEMORY;
+            }
+        }
+        node = child;
+        end = start - 1;
+    }
+
+    rules->nodes[node].flags |= flags;
+    rules->num_host_rules++;
+    return 0;
+}
+
+static int add_ip_rule(filterRules* rules, uint32_t network, int mask_length, int allow) {
+    if (rules->num_ip_rules == rules->ip_rules_capacity) {
+        int capacity = rules->ip_rules_capacity * 2;
+        ip_rule* ip_rules = (ip_rule*)realloc(rules->ip_rules, capacity * sizeof(ip_rule));
+        if (ip_rules == NULL) {
+            perror("realloc\n");
+            return -1;
+        }
+        rules->ip_rules = ip_rules;
+        rules->ip_rules_capacity = capacity;
+    }
+
+    // Create a mask based on the specified mask length
+    uint32_t mask = mask_length == 0 ? 0 : 0xFFFFFFFF << (32 - mask_length);
+    ip_rule* rule = &rules->ip_rules[rules->num_ip_rules++];
+    rule->network = network & mask;
+    rule->mask = mask;
+    rule->allow = allow;
+    rules->num_ip_allow_rules += allow;
+    return 0;
+}
+
+// Parse one line of the filter file, invalid rules are skipped.
+// returns -1 only if memory ran out, so that a partly loaded blocklist is never used
+static int add_rule(filterRules* rules, char* line) {
+    // Trim the line
+    line[strcspn(line, "\r\n")] = '\0';
+    while (isspace((unsigned char)*line)) {
+        line++;
+    }
+    size_t length = strlen(line);
+    while (length > 0 && isspace((unsigned char)line[length - 1])) {
+        line[--length] = '\0';
+    }
+    if (length == 0 || line[0] == '#') {
+        return 0;
+    }
+
+    int allow = 0;
+    if (line[0] == '!') {
+        allow = 1;
+        line++;
+    }
+
+    // Separating the address from the mask length
+    char address[MAX_RULE_SIZE] = {0};
+    strcpy(address, line);
+    char* mask_token = strchr(address, '/');
+    if (mask_token != NULL) {
+        *mask_token++ = '\0';
+    }
+
+    struct in_addr addr;
+    if (inet_pton(AF_INET, address, &addr) == 1) { // This is an IP address filter rule
+        long mask_length = 32;
+        char* mask_end = NULL;
+        if (mask_token != NULL) {
+            mask_length = strtol(mask_token, &mask_end, 10);
+        }
+        if (mask_length < 0 || mask_length > 32 || (mask_token != NULL && (mask_end == mask_token || *mask_end != '\0'))) {
+            fprintf(stderr, "Invalid filter rule: %s\n", line);
+            return 0;
+        }
+        return add_ip_rule(rules, ntohl(addr.s_addr), (int)mask_length, allow);
+    }
+
+    // This is a host filter rule
+    int result = mask_token != NULL ? RULE_INVALID : add_host_rule(rules, line, allow);
+    if (result == RULE_NO_MEMORY) {
+        return -1;
+    }
+    if (result == RULE_INVALID) {
+        fprintf(stderr, "Invalid filter rule: %s\n", line);
+    }
+    return 0;
+}
+
+filterRules* load_filter_rules(FILE* filterFile) {
+    filterRules* rules = (filterRules*)calloc(1, sizeof(filterRules));
+    if (rules == NULL) {
+        perror("calloc\n");
+        return NULL;
+    }
+
+    rules->generation = __atomic_add_fetch(&next_generation, 1, __ATOMIC_RELAXED);
+    rules->nodes_capacity = INITIAL_SLOTS / 2;
+    rules->nodes = (host_node*)malloc(rules->nodes_capacity * sizeof(host_node));
+    rules->num_slots = INITIAL_SLOTS;
+    rules->slots = (unsigned int*)calloc(rules->num_slots, sizeof(unsigned int));
+    rules->labels_capacity = INITIAL_SLOTS * 8;
+    rules->labels = (char*)malloc(rules->labels_capacity);
+    rules->ip_rules_capacity = 16;
+    rules->ip_rules = (ip_rule*)malloc(rules->ip_rules_capacity * sizeof(ip_rule));
+    if (rules->nodes == NULL || rules->slots == NULL || rules->labels == NULL || rules->ip_rules == NULL) {
+        perror("malloc\n");
+        destroy_filter_rules(rules);
+        return NULL;
+    }
+
+    // The root node, with an empty label
+    rules->nodes[0].parent = 0;
+    rules->nodes[0].label = 0;
+    rules->nodes[0].flags = 0;
+    rules->num_nodes = 1;
+    rules->labels[0] = '\0';
+    rules->labels_size = 1;
+
+    // Setting the pointer to the start of the file
+    if (fseek(filterFile, 0, SEEK_SET) != 0) {
+        perror("file pointer\n");
+        destroy_filter_rules(rules);
+        return NULL;
+    }
+
+    char line[MAX_RULE_SIZE] = {0};
+    while (fgets(line, sizeof(line), filterFile) != NULL) {
+        if (add_rule(rules, line) != 0) {
+            fprintf(stderr, "Not enough memory to load the filter rules\n");
+            destroy_filter_rules(rules);
+            return NULL;
+        }
+    }
+
+    return rules;
+}
+
+// Walk the trie from the last label of the host, collecting the rules on the way
+static int match_host(const filterRules* rules, const char* host, int length) {
+    unsigned char block = 0, allow = 0;
+    unsigned int node = 0;
+    int end = length;
+    while (end > 0) {
+        int start = end;
+        while (start > 0 && host[start - 1] != '.') {
+            start--;
+        }
+
+        node = find_child(rules, node, host + start, end - start);
+        if (node == 0) {
+            break;
+        }
+
+        unsigned char flags = rules->nodes[node].flags;
+        if (start > 0) {
+            // The host is below this node
+            block |= flags & HOST_RULE_BLOCK_SUBDOMAINS;
+            allow |= flags & HOST_RULE_ALLOW_SUBDOMAINS;
+        }
+        else {
+            // The host is this node
+            block |= flags & HOST_RULE_BLOCK;
+            allow |= flags & HOST_RULE_ALLOW;
+        }
+        end = start - 1;
+    }
+
+    if (allow) {
+        return HOST_DECISION_ALLOW;
+    }
+    return block ? HOST_DECISION_BLOCK : HOST_DECISION_NONE;
+}
+
+// Decide on the host, first from the decisions this thread made recently
+static int host_decision(const char *host, filterRules* rules) {
+    int decision = HOST_DECISION_NONE;
+    char normalized[DECISION_CACHE_HOST_SIZE];
+    int length = normalize_host(host, normalized, sizeof(normalized));
+    if (length >= 0) {
+        unsigned long hash = hash_bytes(normalized, length);
+        decision_entry* entry = &decision_cache[hash % DECISION_CACHE_SIZE];
+        if (entry->generation == rules->generation && entry->hash == hash && strcmp(entry->host, normalized) == 0) {
+            decision = entry->decision;
+        }
+        else {
+            decision = match_host(rules, normalized, length);
+            entry->generation = rules->generation;
+            entry->hash = hash;
+            entry->decision = decision;
+            memcpy(entry->host, normalized, length + 1);
+        }
+    }
+    else {
+        // Too long for the cache
+        char* long_host = strdup(host);
+        if (long_host == NULL) {
+            perror("strdup\n");
+            return HOST_DECISION_BLOCK;
+        }
+        length = normalize_host(host, long_host, strlen(host) + 1);
+        decision = match_host(rules, long_host, length);
+        free(long_host);
+    }
+
+    return decision;
+}
+
+int isHostFiltered(const char *host, filterRules* rules) {
+    // An IP allow rule could still let a blocked host through, that needs the address
+    return rules->num_ip_allow_rules == 0 && host_decision(host, rules) == HOST_DECISION_BLOCK;
+}
+
+int isFiltered(const char *ip, const char *host, filterRules* rules) {
+    int decision = host_decision(host, rules);
+    if (decision == HOST_DECISION_ALLOW) {
+        return 0;
+    }
+
+    // Check the IP rules, allow rules win over block rules
+    struct in_addr addr;
+    int ip_blocked = 0;
+    if (inet_pton(AF_INET, ip, &addr) == 1) {
+        uint32_t givenIP = ntohl(addr.s_addr);
+        for (int i = 0; i < rules->num_ip_rules; ++i) {
+            if ((givenIP & rules->ip_rules[i].mask) == rules->ip_rules[i].network) {
+                if (rules->ip_rules[i].allow) {
+                    return 0;
+                }
+                ip_blocked = 1;
+            }
+        }
+    }
+
+    return decision == HOST_DECISION_BLOCK || ip_blocked;
+}
+
+size_t filter_rules_memory(const filterRules* rules) {
+    return sizeof(filterRules)
+           + rules->nodes_capacity * sizeof(host_node)
+           + rules->num_slots * sizeof(unsigned int)
+           + rules->labels_capacity
+           + rules->ip_rules_capacity * sizeof(ip_rule);
+}
+
+void destroy_filter_rules(filterRules* rules) {
+    free(rules->nodes);
+    free(rules->slots);
+    free(rules->labels);
+    free(rules->ip_rules);
+    free(rules);
+}
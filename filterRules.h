@@ -0,0 +1,109 @@
+#ifndef FILTER_RULES_H
+#define FILTER_RULES_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * filterRules.h
+ *
+ * This file declares the filter rules, loaded once from the filter file.
+ * Host rules are kept in a trie over the reversed DNS labels of the host
+ * ("ads.example.com" is stored as com -> example -> ads), so a lookup costs
+ * one step per label of the host no matter how many rules there are.
+ * The children of all the nodes are found through one hash table keyed by
+ * the parent node and the label. IP rules are kept in a list and checked
+ * one after the other, so their cost grows with their number.
+ * After loading the rules are read only, so the worker threads look them
+ * up without locking.
+ */
+
+// flags of a trie node, for the rules ending at the node
+#define HOST_RULE_BLOCK 1               //block the host itself
+#define HOST_RULE_BLOCK_SUBDOMAINS 2    //block every host below it
+#define HOST_RULE_ALLOW 4               //allow the host itself
+#define HOST_RULE_ALLOW_SUBDOMAINS 8    //allow every host below it
+
+// per thread cache of the last host decisions
+#define DECISION_CACHE_SIZE 64
+#define DECISION_CACHE_HOST_SIZE 256
+
+
+/**
+ * a node of the host trie, the root is node 0
+ */
+typedef struct host_node_st {
+    unsigned int parent;    //index of the parent node
+    unsigned int label;     //offset of the label in the labels arena
+    unsigned char flags;    //HOST_RULE_* of the rules ending at this node
+} host_node;
+
+/**
+ * an IP rule, "network/mask"
+ */
+typedef struct ip_rule_st {
+    uint32_t network;   //masked network address, host byte order
+    uint32_t mask;
+    int allow;          //1 if this is an allow rule
+} ip_rule;
+
+
+/**
+ * The rules
+ */
+typedef struct _filter_rules_st {
+    unsigned long generation;       //unique id of this rule set, used by the decision caches
+    host_node* nodes;               //the trie nodes
+    unsigned int num_nodes;
+    unsigned int nodes_capacity;
+    unsigned int* slots;            //hash table of (parent, label) to node index, 0 is empty
+    unsigned int num_slots;
+    char* labels;                   //arena of the null terminated labels
+    size_t labels_size;
+    size_t labels_capacity;
+    ip_rule* ip_rules;
+    int num_ip_rules;
+    int num_ip_allow_rules;
+    int ip_rules_capacity;
+    int num_host_rules;
+} filterRules;
+
+
+/**
+ * load_filter_rules reads every rule of the filter file, one rule per line:
+ *   192.168.1.0/24     IP address or range
+ *   example.com        exactly this host
+ *   *.example.com      every host below example.com, but not example.com
+ *   .example.com       example.com and every host below it
+ *   !rule              allow rule, overrides the block rules
+ * host rules are not case sensitive. empty lines and lines starting with '#' are skipped.
+ * returns NULL on failure.
+ */
+filterRules* load_filter_rules(FILE* filterFile);
+
+/**
+ * isFiltered checks the ip and the host against the rules.
+ * allow rules that match override any matching block rule.
+ * returns 1 if filtered, else 0.
+ */
+int isFiltered(const char *ip, const char *host, filterRules* rules);
+
+/**
+ * isHostFiltered decides on the host alone, before it is resolved.
+ * returns 1 if the host rules block it and no IP allow rule could override them,
+ * else 0 and isFiltered must be checked with the address of the host.
+ */
+int isHostFiltered(const char *host, filterRules* rules);
+
+/**
+ * filter_rules_memory returns the number of bytes allocated for the rules.
+ */
+size_t filter_rules_memory(const filterRules* rules);
+
+/**
+ * destroy_filter_rules frees all the memory associated with the rules.
+ */
+void destroy_filter_rules(filterRules* rules);
+
+#endif //FILTER_RULES_H
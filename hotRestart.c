@@ -0,0 +1,341 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include "hotRestart.h"
+
+// Seconds to wait for the other process before giving up on the hand-over
+#define HOT_RESTART_TIMEOUT 5
+// Largest resolver entry of another build that is still drained rather than refused
+#define HOT_RESTART_MAX_ENTRY_SIZE 65536
+
+// Read exactly "length" bytes, returns 0 on success
+static int read_full(int fd, void* buffer, size_t length) {
+    char* ptr = (char*)buffer;
+    while (length > 0) {
+        ssize_t bytes_received = read(fd, ptr, length);
+        if (bytes_received < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_received <= 0) {
+            return -1;
+        }
+        ptr += bytes_received;
+        length -= bytes_received;
+    }
+    return 0;
+}
+
+// Read and throw away "length" bytes, returns 0 on success
+static int skip_full(int fd, size_t length) {
+    char buffer[4096];
+    while (length > 0) {
+        size_t chunk = length < sizeof(buffer) ? length : sizeof(buffer);
+        if (read_full(fd, buffer, chunk) != 0) {
+            return -1;
+        }
+        length -= chunk;
+    }
+    return 0;
+}
+
+// Write exactly "length" bytes, returns 0 on success
+static int write_full(int fd, const void* buffer, size_t length) {
+    const char* ptr = (const char*)buffer;
+    while (length > 0) {
+        // MSG_NOSIGNAL so that a process that went away does not kill us with SIGPIPE
+        ssize_t bytes_written = send(fd, ptr, length, MSG_NOSIGNAL);
+        if (bytes_written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_written <= 0) {
+            return -1;
+        }
+        ptr += bytes_written;
+        length -= bytes_written;
+    }
+    return 0;
+}
+
+// Don't let a stuck peer block the hand-over forever
+static void set_timeout(int fd) {
+    struct timeval timeout = {HOT_RESTART_TIMEOUT, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+}
+
+static int fill_address(struct sockaddr_un* addr, const char* control_path) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(control_path) >= sizeof(addr->sun_path)) {
+        fprintf(stderr, "Control socket path is too long\n");
+        return -1;
+    }
+    strcpy(addr->sun_path, control_path);
+    return 0;
+}
+
+int hot_restart_takeover(const char* control_path, resolverCache* cache, int* new_control_socket,
+                         struct stat* control_stat) {
+    *new_control_socket = -1;
+    struct sockaddr_un addr;
+    if (fill_address(&addr, control_path) != 0) {
+        return -1;
+    }
+
+    int control_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (control_socket < 0) {
+        perror("Control socket\n");
+        return -1;
+    }
+
+    // No one listening means there is no running proxy, that is a cold start
+    if (connect(control_socket, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(control_socket);
+        return -1;
+    }
+    set_timeout(control_socket);
+
+    // Receive the header along with the listening socket
+    hot_restart_header header;
+    struct iovec iov = {&header, sizeof(header)};
+    union {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+
+    if (recvmsg(control_socket, &msg, MSG_WAITALL) != sizeof(header)) {
+        perror("Hot restart receive\n");
+        close(control_socket);
+        return -1;
+    }
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        fprintf(stderr, "Hot restart: no listening socket received\n");
+        close(control_socket);
+        return -1;
+    }
+    int server_socket;
+    memcpy(&server_socket, CMSG_DATA(cmsg), sizeof(int));
+
+    // A snapshot larger than our cache can't come from a compatible proxy, don't allocate or wait for it
+    if (header.magic != HOT_RESTART_MAGIC || header.version != HOT_RESTART_VERSION || header.num_entries < 0 ||
+        header.num_entries > cache->capacity || header.entry_size > HOT_RESTART_MAX_ENTRY_SIZE) {
+        fprintf(stderr, "Hot restart: incompatible running proxy\n");
+        close(server_socket);
+        close(control_socket);
+        return -1;
+    }
+
+    // Receive the resolver snapshot, the socket is still taken over if it can't be loaded.
+    // Entries of another layout are read and dropped, the old process waits for the ack after sending them all.
+    if (header.num_entries > 0 && header.entry_size != sizeof(resolver_entry)) {
+        fprintf(stderr, "Hot restart: resolver entries of %u bytes, expected %zu, starting with a cold cache\n",
+                header.entry_size, sizeof(resolver_entry));
+        if (skip_full(control_socket, (size_t)header.num_entries * header.entry_size) != 0) {
+            perror("Hot restart resolver snapshot\n");
+        }
+    }
+    else if (header.num_entries > 0) {
+        resolver_entry* entries = (resolver_entry*)malloc(header.num_entries * sizeof(resolver_entry));
+        if (entries == NULL) {
+            perror("malloc\n");
+        }
+        else if (read_full(control_socket, entries, header.num_entries * sizeof(resolver_entry)) != 0) {
+            perror("Hot restart resolver snapshot\n");
+        }
+        else {
+            load_resolver_cache(cache, entries, header.num_entries);
+        }
+        free(entries);
+    }
+
+    // Our own control socket must be ready before the old process stops, or nothing could take over from us.
+    // It is bound on a temporary path, the old process still owns "control_path" until it stops.
+    char temp_path[sizeof(addr.sun_path)];
+    struct stat path_stat;
+    int temp_control = -1;
+    if (lstat(control_path, &path_stat) == 0 && !S_ISSOCK(path_stat.st_mode)) {
+        fprintf(stderr, "Control socket path exists and is not a socket: %s\n", control_path);
+    }
+    else if (snprintf(temp_path, sizeof(temp_path), "%s.%d", control_path, (int)getpid()) >= (int)sizeof(temp_path)) {
+        fprintf(stderr, "Control socket path is too long\n");
+    }
+    else {
+        temp_control = hot_restart_listen(temp_path, control_stat);
+    }
+    if (temp_control == -1) {
+        // Without the ack the old process keeps serving
+        fprintf(stderr, "Hot restart: no control socket, not taking over\n");
+        close(server_socket);
+        close(control_socket);
+        return -1;
+    }
+
+    // Tell the old process it can stop accepting
+    char ack = 'A';
+    if (write_full(control_socket, &ack, 1) != 0) {
+        perror("Hot restart ack\n");
+        close(temp_control);
+        unlink(temp_path);
+        close(server_socket);
+        close(control_socket);
+        return -1;
+    }
+    close(control_socket);
+
+    // The old process stops listening on its control socket, the path is ours now.
+    // rename keeps the inode, so control_stat still identifies our file for hot_restart_unlink.
+    if (rename(temp_path, control_path) != 0) {
+        // The socket is already ours, keep serving without a control socket
+        perror("Control rename\n");
+        close(temp_control);
+        unlink(temp_path);
+        return server_socket;
+    }
+
+    *new_control_socket = temp_control;
+    return server_socket;
+}
+
+int hot_restart_listen(const char* control_path, struct stat* control_stat) {
+    struct sockaddr_un addr;
+    if (fill_address(&addr, control_path) != 0) {
+        return -1;
+    }
+
+    int control_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (control_socket < 0) {
+        perror("Control socket\n");
+        return -1;
+    }
+
+    // Replace the socket of the previous process, or a stale one left after a crash, but never another file
+    struct stat path_stat;
+    if (lstat(control_path, &path_stat) == 0) {
+        if (!S_ISSOCK(path_stat.st_mode)) {
+            fprintf(stderr, "Control socket path exists and is not a socket: %s\n", control_path);
+            close(control_socket);
+            return -1;
+        }
+        unlink(control_path);
+    }
+
+    // Only our user may connect, the socket file is created with 0600
+    mode_t old_umask = umask(0077);
+    int bound = bind(control_socket, (struct sockaddr*)&addr, sizeof(addr));
+    umask(old_umask);
+    if (bound < 0) {
+        perror("Control bind\n");
+        close(control_socket);
+        return -1;
+    }
+
+    // Remember which file is ours, so that we never remove the socket of a newer process
+    if (lstat(control_path, control_stat) != 0) {
+        perror("Control stat\n");
+        unlink(control_path);
+        close(control_socket);
+        return -1;
+    }
+
+    if (listen(control_socket, 1) < 0) {
+        perror("Control listen\n");
+        close(control_socket);
+        return -1;
+    }
+
+    return control_socket;
+}
+
+int hot_restart_handoff(int control_socket, int server_socket, resolverCache* cache) {
+    int new_process = accept(control_socket, NULL, NULL);
+    if (new_process < 0) {
+        perror("Control accept\n");
+        return -1;
+    }
+
+    // Only a process of our own user may take the listening socket over
+    struct ucred credentials;
+    socklen_t credentials_length = sizeof(credentials);
+    if (getsockopt(new_process, SOL_SOCKET, SO_PEERCRED, &credentials, &credentials_length) != 0) {
+        perror("Control peer credentials\n");
+        close(new_process);
+        return -1;
+    }
+    if (credentials.uid != geteuid()) {
+        fprintf(stderr, "Hot restart: refused process %d of user %d\n", (int)credentials.pid, (int)credentials.uid);
+        close(new_process);
+        return -1;
+    }
+    set_timeout(new_process);
+
+    resolver_entry* entries = NULL;
+    int num_entries = snapshot_resolver_cache(cache, &entries);
+    if (num_entries < 0) {
+        // Hand over the socket with cold state rather than not at all
+        num_entries = 0;
+    }
+
+    // Send the header along with the listening socket
+    hot_restart_header header = {HOT_RESTART_MAGIC, HOT_RESTART_VERSION, num_entries, sizeof(resolver_entry)};
+    struct iovec iov = {&header, sizeof(header)};
+    union {
+        char buffer[CMSG_SPACE(sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buffer;
+    msg.msg_controllen = sizeof(control.buffer);
+
+    struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &server_socket, sizeof(int));
+
+    int result = -1;
+    char ack = 0;
+    if (sendmsg(new_process, &msg, MSG_NOSIGNAL) != sizeof(header)) {
+        perror("Hot restart send\n");
+    }
+    else if (num_entries > 0 && write_full(new_process, entries, num_entries * sizeof(resolver_entry)) != 0) {
+        perror("Hot restart resolver snapshot\n");
+    }
+    // Wait for the new process to confirm it is accepting before we stop
+    else if (read_full(new_process, &ack, 1) != 0 || ack != 'A') {
+        fprintf(stderr, "Hot restart: new process did not confirm, keep serving\n");
+    }
+    else {
+        result = 0;
+    }
+
+    free(entries);
+    close(new_process);
+    return result;
+}
+
+void hot_restart_unlink(const char* control_path, const struct stat* control_stat) {
+    struct stat path_stat;
+    if (lstat(control_path, &path_stat) == 0 && S_ISSOCK(path_stat.st_mode) &&
+        path_stat.st_dev == control_stat->st_dev && path_stat.st_ino == control_stat->st_ino) {
+        unlink(control_path);
+    }
+}
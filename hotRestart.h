@@ -0,0 +1,70 @@
+#ifndef HOT_RESTART_H
+#define HOT_RESTART_H
+
+#include <sys/stat.h>
+#include "resolverCache.h"
+
+/**
+ * hotRestart.h
+ *
+ * This file declares the hand-over of a running proxy to a new process.
+ * The running proxy waits for the new process on a Unix domain control socket.
+ * When it connects, the listening socket is passed to it with SCM_RIGHTS,
+ * followed by a snapshot of the resolver cache. Once the new process confirms,
+ * the old one stops accepting, drains the jobs it already accepted and exits,
+ * while the new process keeps accepting on the same socket without a gap.
+ */
+
+#define HOT_RESTART_MAGIC 0x50524852  //"PRHR"
+#define HOT_RESTART_VERSION 2
+
+
+/**
+ * the header sent together with the listening socket
+ */
+typedef struct hot_restart_header_st {
+    unsigned int magic;         //HOT_RESTART_MAGIC
+    unsigned int version;       //HOT_RESTART_VERSION
+    int num_entries;            //number of resolver_entry that follow
+    unsigned int entry_size;    //sizeof(resolver_entry) of the sender
+} hot_restart_header;
+
+
+/**
+ * hot_restart_takeover connects to a running proxy on "control_path" and takes over its
+ * listening socket, loading the received resolver entries into "cache".
+ * the hand-over is refused if the proxy sends more entries than "cache" holds. entries
+ * of a different size are skipped, the socket is still taken over with a cold cache.
+ * before confirming, the control socket of this process is created, as hot_restart_listen
+ * does, and stored in "control_socket" and "control_stat". if it can't be created the
+ * hand-over is refused and the running proxy keeps serving. "control_socket" is -1 if the
+ * socket was taken over but the control socket could not be moved to "control_path".
+ * returns the listening socket, or -1 if there is no running proxy to take over from.
+ */
+int hot_restart_takeover(const char* control_path, resolverCache* cache, int* control_socket,
+                         struct stat* control_stat);
+
+/**
+ * hot_restart_listen creates the control socket on "control_path", replacing any
+ * previous socket there, so that the next process can take over from this one.
+ * fails if "control_path" exists and is not a socket. the file created is stored
+ * in "control_stat", for hot_restart_unlink.
+ * returns the control socket, or -1 on failure.
+ */
+int hot_restart_listen(const char* control_path, struct stat* control_stat);
+
+/**
+ * hot_restart_handoff accepts the new process waiting on the control socket and hands
+ * "server_socket" and a snapshot of "cache" over to it.
+ * returns 0 once the new process confirmed it took over, else -1 and this process
+ * should keep serving.
+ */
+int hot_restart_handoff(int control_socket, int server_socket, resolverCache* cache);
+
+/**
+ * hot_restart_unlink removes the control socket file, only if it is still the one
+ * created by hot_restart_listen and not the socket of a process that took over.
+ */
+void hot_restart_unlink(const char* control_path, const struct stat* control_stat);
+
+#endif //HOT_RESTART_H
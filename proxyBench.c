@@ -0,0 +1,641 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include "threadpool.h"
+#include "proxyUtils.h"
+#include "filterRules.h"
+
+// Minimum time of each run of a benchmark
+#define BENCH_TARGET_NS 100000000LL
+#define MAX_BENCH_RESULTS 64
+#define MAX_BENCH_COUNT 100
+#define DEFAULT_BENCH_COUNT 5
+#define DEFAULT_MAX_RULES 1000000
+#define DEFAULT_THRESHOLD 10.0
+
+/*
+ * Allocation counting.
+ * proxyBench replaces malloc, calloc, realloc and free with these, forwarding to the glibc
+ * allocator. glibc calls them too for its own allocations (strdup, fopen, getaddrinfo...),
+ * so allocations made inside libc on behalf of the proxy code are counted as well.
+ */
+static long allocations = 0;
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t nmemb, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void __libc_free(void *ptr);
+
+void *malloc(size_t size){
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t nmemb, size_t size){
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(nmemb, size);
+}
+
+void *realloc(void *ptr, size_t size){
+    __atomic_add_fetch(&allocations, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(ptr, size);
+}
+
+void free(void *ptr){
+    __libc_free(ptr);
+}
+
+// A benchmark body runs the measured operation "iterations" times
+typedef void (*bench_fn)(void *ctx, long iterations);
+
+typedef struct {
+    char name[128];
+    long iterations;
+    double min_ns_per_op;
+    double median_ns_per_op;
+    double max_ns_per_op;
+    double allocs_per_op;
+} bench_result;
+
+// Number of times each benchmark is run, set with -count
+static int bench_count = DEFAULT_BENCH_COUNT;
+
+static long long now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int compareDoubles(const void *a, const void *b){
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Run the benchmark with a growing number of iterations until it takes at least BENCH_TARGET_NS,
+// then run it bench_count times with that many iterations and report the min, median and max
+static void runBenchmark(const char *name, bench_fn fn, void *ctx){
+    long iterations = 1;
+    long long elapsed;
+    long allocated;
+
+    while (1) {
+        __atomic_store_n(&allocations, 0, __ATOMIC_RELAXED);
+        long long start = now_ns();
+        fn(ctx, iterations);
+        elapsed = now_ns() - start;
+        allocated = __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+
+        if (elapsed >= BENCH_TARGET_NS || iterations >= 1000000000L) {
+            break;
+        }
+
+        // Predict the iterations needed to reach the target time, growing by at most 100x each round
+        long long next = elapsed > 0 ? (long long)iterations * BENCH_TARGET_NS / elapsed * 6 / 5 : iterations * 100LL;
+        if (next > iterations * 100LL) {
+            next = iterations * 100LL;
+        }
+        if (next <= iterations) {
+            next = iterations + 1;
+        }
+        iterations = (long)next;
+    }
+
+    double ns_per_op[MAX_BENCH_COUNT];
+    long min_allocated = allocated;
+    for (int run = 0; run < bench_count; ++run) {
+        __atomic_store_n(&allocations, 0, __ATOMIC_RELAXED);
+        long long start = now_ns();
+        fn(ctx, iterations);
+        ns_per_op[run] = (double)(now_ns() - start) / iterations;
+        allocated = __atomic_load_n(&allocations, __ATOMIC_RELAXED);
+        if (allocated < min_allocated) {
+            min_allocated = allocated;
+        }
+    }
+    qsort(ns_per_op, bench_count, sizeof(double), compareDoubles);
+
+    printf("%-40s %12ld %14.1f %14.1f %14.1f %12.2f\n", name, iterations, ns_per_op[0],
+           ns_per_op[bench_count / 2], ns_per_op[bench_count - 1], (double)min_allocated / iterations);
+    fflush(stdout);
+}
+
+/*
+ * Filter benchmarks
+ */
+#define NUM_PROBES 1024
+
+typedef struct {
+    filterRules *rules;
+    const char *ip;
+    char hosts[NUM_PROBES][64];
+} filter_ctx;
+
+// Write "count" rules to a temporary filter file, in the mix of suffix, wildcard and exact rules of blocklists
+static FILE *createFilterFile(long count){
+    FILE *filterFile = tmpfile();
+    if (filterFile == NULL) {
+        perror("tmpfile\n");
+        exit(1);
+    }
+    for (long i = 0; i < count; ++i) {
+        switch (i % 4) {
+            case 0:
+                fprintf(filterFile, ".site%ld.example\n", i);
+                break;
+            case 1:
+                fprintf(filterFile, "*.ads%ld.net\n", i);
+                break;
+            case 2:
+                fprintf(filterFile, "Host%ld.Blocked.Example\n", i);
+                break;
+            default:
+                // A few IP subnets, their check is a linear scan
+                if (i < 64) {
+                    fprintf(filterFile, "10.%ld.0.0/16\n", i);
+                } else {
+                    fprintf(filterFile, "tracker%ld.com\n", i);
+                }
+        }
+    }
+    fflush(filterFile);
+    return filterFile;
+}
+
+// Write "count" IP rules, one per address of 10.0.0.0/8
+static FILE *createIPFilterFile(long count){
+    FILE *filterFile = tmpfile();
+    if (filterFile == NULL) {
+        perror("tmpfile\n");
+        exit(1);
+    }
+    for (long i = 0; i < count; ++i) {
+        fprintf(filterFile, "10.%ld.%ld.%ld\n", (i >> 16) & 0xFF, (i >> 8) & 0xFF, i & 0xFF);
+    }
+    fflush(filterFile);
+    return filterFile;
+}
+
+// Probe hosts spread over the rules. Probe k is built for the rule kind k % 4 of createFilterFile:
+// suffix, wildcard and exact probes are blocked, the last kind is not listed at all
+static void createProbes(filter_ctx *ctx, long count){
+    long step = count / NUM_PROBES + 1;
+    for (long k = 0; k < NUM_PROBES; ++k) {
+        long j = (k * step) % count;
+        // Move j to a rule of the same kind as the probe
+        j = j - j % 4 + k % 4;
+        if (j >= count) {
+            j -= 4;
+        }
+        switch (k % 4) {
+            case 0:
+                snprintf(ctx->hosts[k], sizeof(ctx->hosts[k]), "www.site%ld.example", j);
+                break;
+            case 1:
+                snprintf(ctx->hosts[k], sizeof(ctx->hosts[k]), "cdn.ads%ld.net", j);
+                break;
+            case 2:
+                snprintf(ctx->hosts[k], sizeof(ctx->hosts[k]), "host%ld.blocked.example", j);
+                break;
+            default:
+                snprintf(ctx->hosts[k], sizeof(ctx->hosts[k]), "www.unlisted%ld.org", j);
+        }
+    }
+}
+
+// Check every probe gives the expected decision, twice so that the answers of the decision cache are checked too
+static void checkProbes(filter_ctx *ctx, long count){
+    for (int pass = 0; pass < 2; ++pass) {
+        for (long k = 0; k < NUM_PROBES; ++k) {
+            int expected = k % 4 != 3;
+            if (isFiltered(ctx->ip, ctx->hosts[k], ctx->rules) != expected) {
+                fprintf(stderr, "isFiltered/rules=%ld: %s should %sbe filtered\n", count, ctx->hosts[k],
+                        expected ? "" : "not ");
+                exit(1);
+            }
+        }
+    }
+}
+
+// Fixed cases of the rule kinds, checked before any timing
+static void checkFilterRules(void){
+    static const char *ruleSets[2] = {
+            "*.ads.example\n.Track.NET\n!good.track.net\nexample.com\n",
+            "0.0.0.0/0\n!10.1.2.3\n"
+    };
+    static const struct {
+        int rule_set;
+        const char *ip;
+        const char *host;
+        int expected;
+    } cases[] = {
+            {0, "192.0.2.1", "x.ads.example", 1},       // wildcard matches the subdomains
+            {0, "192.0.2.1", "a.b.ads.example", 1},
+            {0, "192.0.2.1", "ads.example", 0},         // but not the domain itself
+            {0, "192.0.2.1", "track.net", 1},           // suffix matches the domain itself
+            {0, "192.0.2.1", "a.track.net", 1},         // and its subdomains
+            {0, "192.0.2.1", "good.track.net", 0},      // allow rules override
+            {0, "192.0.2.1", "Example.COM.", 1},        // case and trailing dot are normalized
+            {0, "192.0.2.1", "www.example.com", 0},     // exact rules match only the host
+            {0, "192.0.2.1", "net", 0},
+            {1, "192.0.2.1", "www.example.org", 1},     // 0.0.0.0/0 matches every address
+            {1, "10.1.2.3", "www.example.org", 0}
+    };
+
+    filterRules *rules[2];
+    for (int i = 0; i < 2; ++i) {
+        FILE *filterFile = tmpfile();
+        if (filterFile == NULL) {
+            perror("tmpfile\n");
+            exit(1);
+        }
+        fputs(ruleSets[i], filterFile);
+        rules[i] = load_filter_rules(filterFile);
+        fclose(filterFile);
+        if (rules[i] == NULL) {
+            exit(1);
+        }
+    }
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        if (isFiltered(cases[i].ip, cases[i].host, rules[cases[i].rule_set]) != cases[i].expected) {
+            fprintf(stderr, "isFiltered: %s (%s) should %sbe filtered\n", cases[i].host, cases[i].ip,
+                    cases[i].expected ? "" : "not ");
+            exit(1);
+        }
+    }
+
+    // Blocked hosts are refused before resolving them, unless an IP allow rule could let them through
+    if (isHostFiltered("x.ads.example", rules[0]) != 1 || isHostFiltered("good.track.net", rules[0]) != 0 ||
+        isHostFiltered("www.example.org", rules[1]) != 0) {
+        fprintf(stderr, "isHostFiltered: wrong decision\n");
+        exit(1);
+    }
+
+    destroy_filter_rules(rules[0]);
+    destroy_filter_rules(rules[1]);
+}
+
+// IP rules are checked one after the other, an address that matches none of them is the worst case
+static void benchIsFilteredIP(void *p, long iterations){
+    filter_ctx *ctx = (filter_ctx*)p;
+    int filtered = 0;
+    for (long i = 0; i < iterations; ++i) {
+        filtered += isFiltered(ctx->ip, "www.unlisted.org", ctx->rules);
+    }
+    if (filtered < 0) {
+        printf("%d\n", filtered);
+    }
+}
+
+// A different host on each call, more than the decision cache holds, so every lookup walks the trie
+static void benchIsFiltered(void *p, long iterations){
+    filter_ctx *ctx = (filter_ctx*)p;
+    int filtered = 0;
+    for (long i = 0; i < iterations; ++i) {
+        filtered += isFiltered(ctx->ip, ctx->hosts[i % NUM_PROBES], ctx->rules);
+    }
+    if (filtered < 0) {
+        printf("%d\n", filtered);
+    }
+}
+
+// The same few hosts again and again, answered by the decision cache
+static void benchIsFilteredCached(void *p, long iterations){
+    filter_ctx *ctx = (filter_ctx*)p;
+    int filtered = 0;
+    for (long i = 0; i < iterations; ++i) {
+        filtered += isFiltered(ctx->ip, ctx->hosts[i % 4], ctx->rules);
+    }
+    if (filtered < 0) {
+        printf("%d\n", filtered);
+    }
+}
+
+/*
+ * Request benchmarks, run over a small corpus of typical browser and tool requests
+ */
+static const char *requestCorpus[] = {
+        "GET http://www.example.com/index.html HTTP/1.1\r\n"
+        "Host: www.example.com\r\n"
+        "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n"
+        "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+        "Accept-Language: en-US,en;q=0.5\r\n"
+        "Accept-Encoding: gzip, deflate\r\n"
+        "Connection: keep-alive\r\n"
+        "Upgrade-Insecure-Requests: 1\r\n"
+        "\r\n",
+        "GET http://api.example.org:8080/v1/items?page=2 HTTP/1.1\r\n"
+        "Host: api.example.org:8080\r\n"
+        "User-Agent: curl/8.5.0\r\n"
+        "Accept: */*\r\n"
+        "\r\n",
+        "GET / HTTP/1.0\r\n"
+        "User-Agent: Wget/1.21.3\r\n"
+        "Accept: */*\r\n"
+        "Host: static.example.net\r\n"
+        "Connection: Keep-Alive\r\n"
+        "\r\n",
+        "GET http://images.example.com/logo.png HTTP/1.1\r\n"
+        "Host: images.example.com\r\n"
+        "Referer: http://www.example.com/index.html\r\n"
+        "Accept: image/avif,image/webp,*/*\r\n"
+        "Cookie: session=0123456789abcdef; theme=dark\r\n"
+        "Connection: keep-alive\r\n"
+        "\r\n"
+};
+#define CORPUS_SIZE (sizeof(requestCorpus) / sizeof(requestCorpus[0]))
+
+static void benchParseRequest(void *p, long iterations){
+    (void)p;
+    int failed = 0;
+    for (long i = 0; i < iterations; ++i) {
+        char method[16] = {0}, path[1024] = {0}, protocol[16] = {0}, host[MAX_HOST_SIZE] = {0};
+        failed += parseRequest(requestCorpus[i % CORPUS_SIZE], method, path, protocol, host) != 0;
+    }
+    if (failed) {
+        fprintf(stderr, "parseRequest: corpus request rejected\n");
+        exit(1);
+    }
+}
+
+// setConnectionClose edits the request in place, so each operation includes copying a fresh request
+static void benchSetConnectionClose(void *p, long iterations){
+    (void)p;
+    char request[MAX_REQUEST_SIZE];
+    size_t lengths[CORPUS_SIZE];
+    for (size_t i = 0; i < CORPUS_SIZE; ++i) {
+        lengths[i] = strlen(requestCorpus[i]) + 1;
+    }
+    for (long i = 0; i < iterations; ++i) {
+        memcpy(request, requestCorpus[i % CORPUS_SIZE], lengths[i % CORPUS_SIZE]);
+        setConnectionClose(request);
+    }
+}
+
+/*
+ * Error response benchmarks
+ */
+static void benchBuildErrorMessage(void *p, long iterations){
+    (void)p;
+    char response[MAX_REQUEST_SIZE];
+    for (long i = 0; i < iterations; ++i) {
+        buildErrorMessage(response, sizeof(response), 403, 1, 1);
+    }
+}
+
+static void benchDisplayErrorMessage(void *p, long iterations){
+    int null_fd = *(int*)p;
+    for (long i = 0; i < iterations; ++i) {
+        displayErrorMessage(null_fd, 403, 1, 1);
+    }
+}
+
+/*
+ * Threadpool benchmarks
+ */
+typedef struct {
+    threadpool *pool;
+    pthread_mutex_t lock;
+    pthread_cond_t done_cond;
+    long done;
+} pool_ctx;
+
+static int markDone(void *p){
+    pool_ctx *ctx = (pool_ctx*)p;
+    pthread_mutex_lock(&ctx->lock);
+    ctx->done++;
+    pthread_cond_signal(&ctx->done_cond);
+    pthread_mutex_unlock(&ctx->lock);
+    return 0;
+}
+
+static void waitDone(pool_ctx *ctx, long target){
+    pthread_mutex_lock(&ctx->lock);
+    while (ctx->done < target) {
+        pthread_cond_wait(&ctx->done_cond, &ctx->lock);
+    }
+    pthread_mutex_unlock(&ctx->lock);
+}
+
+// Round trip latency: dispatch one job and wait until a worker has run it
+static void benchDispatchHandoff(void *p, long iterations){
+    pool_ctx *ctx = (pool_ctx*)p;
+    ctx->done = 0;
+    for (long i = 0; i < iterations; ++i) {
+        dispatch(ctx->pool, markDone, ctx);
+        waitDone(ctx, i + 1);
+    }
+}
+
+// Throughput: queue all the jobs first, then wait for the workers to drain them
+static void benchDispatchBurst(void *p, long iterations){
+    pool_ctx *ctx = (pool_ctx*)p;
+    ctx->done = 0;
+    for (long i = 0; i < iterations; ++i) {
+        dispatch(ctx->pool, markDone, ctx);
+    }
+    waitDone(ctx, iterations);
+}
+
+/*
+ * Comparison of two result files
+ */
+static int readResults(const char *path, bench_result *results){
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        perror("Results file open error\n");
+        exit(1);
+    }
+    char line[256];
+    int count = 0;
+    while (count < MAX_BENCH_RESULTS && fgets(line, sizeof(line), file) != NULL) {
+        if (line[0] == '#') {
+            continue;
+        }
+        bench_result *result = &results[count];
+        if (sscanf(line, "%127s %ld %lf %lf %lf %lf", result->name, &result->iterations, &result->min_ns_per_op,
+                   &result->median_ns_per_op, &result->max_ns_per_op, &result->allocs_per_op) == 6) {
+            count++;
+        }
+    }
+    fclose(file);
+    return count;
+}
+
+// Returns the number of benchmarks that got slower or allocate more than before.
+// A benchmark is slower only when its fastest new run is slower than the slowest old run by more
+// than the threshold, so the noise between runs of the same build is not taken for a regression.
+static int compareResults(const char *old_path, const char *new_path, double threshold){
+    bench_result old_results[MAX_BENCH_RESULTS], new_results[MAX_BENCH_RESULTS];
+    int old_count = readResults(old_path, old_results);
+    int new_count = readResults(new_path, new_results);
+    int regressions = 0;
+
+    printf("# %-38s %25s %25s %9s %10s %10s\n", "benchmark", "old ns/op (min-max)", "new ns/op (min-max)",
+           "median", "old allocs", "new allocs");
+    for (int i = 0; i < new_count; ++i) {
+        bench_result *new_result = &new_results[i];
+        bench_result *old_result = NULL;
+        for (int j = 0; j < old_count; ++j) {
+            if (strcmp(old_results[j].name, new_result->name) == 0) {
+                old_result = &old_results[j];
+                break;
+            }
+        }
+        if (old_result == NULL) {
+            printf("%-40s %25s %12.1f-%-12.1f %9s %10s %10.2f\n", new_result->name, "-", new_result->min_ns_per_op,
+                   new_result->max_ns_per_op, "new", "-", new_result->allocs_per_op);
+            continue;
+        }
+
+        double delta = old_result->median_ns_per_op > 0 ? (new_result->median_ns_per_op - old_result->median_ns_per_op)
+                                                          * 100.0 / old_result->median_ns_per_op : 0;
+        // Decide on the medians, the old range only tells a real slowdown from the noise of the old runs
+        int past_threshold = delta > threshold;
+        int slower = past_threshold && new_result->median_ns_per_op > old_result->max_ns_per_op;
+        int regressed = slower || new_result->allocs_per_op > old_result->allocs_per_op + 0.01;
+        regressions += regressed;
+        printf("%-40s %12.1f-%-12.1f %12.1f-%-12.1f %+8.1f%% %10.2f %10.2f%s\n", new_result->name,
+               old_result->min_ns_per_op, old_result->max_ns_per_op, new_result->min_ns_per_op,
+               new_result->max_ns_per_op, delta, old_result->allocs_per_op, new_result->allocs_per_op,
+               regressed ? "  REGRESSION" : past_threshold ? "  (within old range)" : "");
+    }
+
+    // A benchmark that is gone can't be compared, it may have failed or been renamed
+    for (int i = 0; i < old_count; ++i) {
+        int found = 0;
+        for (int j = 0; j < new_count && !found; ++j) {
+            found = strcmp(old_results[i].name, new_results[j].name) == 0;
+        }
+        if (!found) {
+            printf("%-40s %12.1f-%-12.1f %25s %9s %10.2f %10s  MISSING\n", old_results[i].name,
+                   old_results[i].min_ns_per_op, old_results[i].max_ns_per_op, "-", "-",
+                   old_results[i].allocs_per_op, "-");
+            regressions++;
+        }
+    }
+    return regressions;
+}
+
+// Main function
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && strcmp(argv[1], "--compare") == 0) {
+        if (argc != 4 && argc != 5) {
+            printf("Usage: proxyBench --compare <old-results> <new-results> [threshold-percent]\n");
+            exit(1);
+        }
+        double threshold = argc == 5 ? atof(argv[4]) : DEFAULT_THRESHOLD;
+        return compareResults(argv[2], argv[3], threshold) > 0 ? 1 : 0;
+    }
+
+    int arg = 1;
+    if (argc >= 3 && strcmp(argv[1], "-count") == 0) {
+        bench_count = atoi(argv[2]);
+        arg = 3;
+    }
+    if (argc - arg > 1 || bench_count <= 0 || bench_count > MAX_BENCH_COUNT) {
+        printf("Usage: proxyBench [-count <runs>] [max-filter-rules]\n");
+        printf("       proxyBench --compare <old-results> <new-results> [threshold-percent]\n");
+        exit(1);
+    }
+    long max_rules = argc - arg == 1 ? atol(argv[arg]) : DEFAULT_MAX_RULES;
+
+    printf("# %-38s %12s %14s %14s %14s %12s\n", "benchmark", "iterations", "min ns/op", "median ns/op",
+           "max ns/op", "allocs/op");
+
+    checkFilterRules();
+
+    for (long count = 10; count <= max_rules; count *= 10) {
+        char name[128];
+        filter_ctx *ctx = (filter_ctx*)malloc(sizeof(filter_ctx));
+        if (ctx == NULL) {
+            perror("malloc\n");
+            exit(1);
+        }
+        FILE *filterFile = createFilterFile(count);
+        ctx->rules = load_filter_rules(filterFile);
+        fclose(filterFile);
+        if (ctx->rules == NULL) {
+            exit(1);
+        }
+        ctx->ip = "192.0.2.1";
+        createProbes(ctx, count);
+        checkProbes(ctx, count);
+
+        size_t memory = filter_rules_memory(ctx->rules);
+        printf("# isFiltered/rules=%ld memory: %zu bytes, %.1f MB per million rules\n", count,
+               memory, (double)memory / count);
+
+        snprintf(name, sizeof(name), "isFiltered/rules=%ld", count);
+        runBenchmark(name, benchIsFiltered, ctx);
+        snprintf(name, sizeof(name), "isFiltered/cached/rules=%ld", count);
+        runBenchmark(name, benchIsFilteredCached, ctx);
+
+        destroy_filter_rules(ctx->rules);
+        free(ctx);
+    }
+
+    for (long count = 10; count <= max_rules; count *= 10) {
+        char name[128];
+        filter_ctx *ctx = (filter_ctx*)malloc(sizeof(filter_ctx));
+        if (ctx == NULL) {
+            perror("malloc\n");
+            exit(1);
+        }
+        FILE *filterFile = createIPFilterFile(count);
+        ctx->rules = load_filter_rules(filterFile);
+        fclose(filterFile);
+        if (ctx->rules == NULL) {
+            exit(1);
+        }
+
+        // The last rule matches its address, the probe address matches none
+        char last_ip[INET_ADDRSTRLEN];
+        snprintf(last_ip, sizeof(last_ip), "10.%ld.%ld.%ld", ((count - 1) >> 16) & 0xFF, ((count - 1) >> 8) & 0xFF,
+                 (count - 1) & 0xFF);
+        ctx->ip = "192.0.2.1";
+        if (isFiltered(last_ip, "www.unlisted.org", ctx->rules) != 1 ||
+            isFiltered(ctx->ip, "www.unlisted.org", ctx->rules) != 0) {
+            fprintf(stderr, "isFiltered/iprules=%ld: wrong decision\n", count);
+            exit(1);
+        }
+
+        snprintf(name, sizeof(name), "isFiltered/iprules=%ld", count);
+        runBenchmark(name, benchIsFilteredIP, ctx);
+
+        destroy_filter_rules(ctx->rules);
+        free(ctx);
+    }
+
+    runBenchmark("parseRequest", benchParseRequest, NULL);
+    runBenchmark("setConnectionClose", benchSetConnectionClose, NULL);
+    runBenchmark("buildErrorMessage", benchBuildErrorMessage, NULL);
+
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd < 0) {
+        perror("open /dev/null\n");
+        exit(1);
+    }
+    runBenchmark("displayErrorMessage", benchDisplayErrorMessage, &null_fd);
+    close(null_fd);
+
+    pool_ctx ctx;
+    ctx.pool = create_threadpool(4);
+    if (ctx.pool == NULL) {
+        exit(1);
+    }
+    pthread_mutex_init(&ctx.lock, NULL);
+    pthread_cond_init(&ctx.done_cond, NULL);
+    runBenchmark("dispatch/handoff", benchDispatchHandoff, &ctx);
+    runBenchmark("dispatch/burst", benchDispatchBurst, &ctx);
+    destroy_threadpool(ctx.pool);
+    pthread_mutex_destroy(&ctx.lock);
+    pthread_cond_destroy(&ctx.done_cond);
+
+    return 0;
+}
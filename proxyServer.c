@@ -4,150 +4,30 @@
 #include <string.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
-#include <netdb.h>
-#include <time.h>
-#include <ctype.h>
+#include <poll.h>
 #include "threadpool.h"
+#include "proxyUtils.h"
+#include "filterRules.h"
+#include "resolverCache.h"
+#include "hotRestart.h"
 
-#define MAX_REQUEST_SIZE 2048
 #define MAX_FILTER_SIZE 128
-#define MAX_HOST_SIZE 1024
+#define RESOLVER_CACHE_SIZE 1024
 
 // Define structures for thread arguments and filter data
 typedef struct {
     int client_socket;
-    FILE *filterFile;
+    filterRules *filter;
+    resolverCache *resolver;
     int port;
 } thread_args;
 
-void displayErrorMessage(int client_socket, int error_num, int message, int status){
-    const char* errorMessages[5] = {
-            "Bad Request.",
-            "Access denied.",
-            "File not found.",
-            "Some server side error.",
-            "Method is not supported."
-    };
-
-    const char* statusMessages[5] = {
-            "Bad Request",
-            "Forbidden",
-            "Not Found",
-            "Internal Server Error",
-            "Not supported"
-    };
-
-    // Get the current time
-    time_t current_time;
-    time(&current_time);
-
-    // Format the time as shown in the files
-    char formatted_time[256] = {0};
-    struct tm* time_info = gmtime(&current_time);
-    strftime(formatted_time, sizeof(formatted_time), "%a, %d %b %Y %H:%M:%S GMT", time_info);
-
-    // Building the body of the response
-    char body[512] = {0};
-    snprintf(body, sizeof(body),
-             "<HTML><HEAD><TITLE>%d %s</TITLE></HEAD>\r\n<BODY><H4>%d %s</H4>\r\n%s\r\n</BODY></HTML>",
-             error_num, statusMessages[status], error_num, statusMessages[status], errorMessages[message]);
-
-    // Building the headers of the response
-    int content_length = strlen(body);
-    char header[1024] = {0};
-    snprintf(header, sizeof(header), "HTTP/1.1 %d %s\r\nServer: webserver/1.0\r\nDate: %s\r\n"
-                                     "Content-Type: text/html\r\nContent-Length: %d\r\nConnection: close",
-             error_num, statusMessages[status], formatted_time, content_length);
-
-    // Combine both strings
-    char error_response[2048] = {0};
-    snprintf(error_response, sizeof(error_response), "%s\r\n\r\n%s", header, body);
-
-    // Send the error_response to the client
-    write(client_socket, error_response, strlen(error_response));
-}
-
-// Function to check the IP match of the filter rule
-int isIPMatching(const char *givenIP, const char *filterIP, int maskLength) {
-    // Convert IP addresses to numerical representations (in network byte order)
-    uint32_t givenIPNumeric = ntohl(inet_addr(givenIP));
-    uint32_t filterIPNumeric = ntohl(inet_addr(filterIP));
-
-    // Create a mask based on the specified mask length
-    uint32_t mask = 0xFFFFFFFF << (32 - maskLength);
-
-    // Apply the mask to both IP addresses
-    uint32_t maskedGivenIP = givenIPNumeric & mask;
-    uint32_t maskedFilterIP = filterIPNumeric & mask;
-
-    // Check if the masked IP addresses match
-    return (maskedGivenIP == maskedFilterIP);
-}
-
-// Function to check if an address matches a filter rule
-int isFiltered(const char *ip, const char *host, FILE *filterFile) {
-    char filterRule[2048] = {0};
-
-    // Setting the pointer to the start of the file
-    if (fseek(filterFile, 0, SEEK_SET) != 0) {
-        perror("file pointer\n");
-        return 2; // Problem
-    }
-
-    // While we have more address in the file continue checking
-    while (fgets(filterRule, sizeof(filterRule), filterFile) != NULL) {
-        // Remove newline character at the end
-        filterRule[strcspn(filterRule, "\r\n")] = '\0';
-
-        // Check if the filter rule is an IP
-        if (isdigit(*filterRule)) { // This is an IP address filter rule
-            int maskLength = 32;
-            // Separating the address from the mask length
-            char* ip_token = strtok(filterRule, "/");
-            char tempIP[128] = {0};
-            strcpy(tempIP, ip_token);
-            ip_token = strtok(NULL, "");
-            if (ip_token != NULL){
-                maskLength = atoi(ip_token);
-            }
-
-            if (isIPMatching(ip, tempIP, maskLength)) {
-                return 1; // Filtered
-            }
-        } else { // This is a host filter rule
-            if (strcmp(host, filterRule) == 0) { // Host matches the filter rule
-                return 1; // Filtered
-            }
-        }
-    }
-    return 0; // IP address is not filtered
-}
-
-int receiveResponse(int server_sock, int client_sock){
-    unsigned char *response = (unsigned char *)malloc(1024);
-    while (1){
-        // Read the response from the server
-        ssize_t bytes_received = read(server_sock, response, 1024);
-        if (bytes_received <= 0) {
-            break;
-        }
-        // Write the response to the client
-        ssize_t bytes_written = write(client_sock, response, bytes_received);
-        if (bytes_written < 0) {
-            free(response);
-            return 1;
-        }
-    }
-    free(response);
-    return 0;
-}
-
 // Function to handle individual client requests
 void handle_client(thread_args* args) {
     // Extract client socket and filter from thread arguments
     int client_socket = args->client_socket;
-    // Save the filterFile pointer into a variable
-    FILE *localFilterFile = args->filterFile;
+    // Save the filter rules pointer into a variable
+    filterRules *localFilter = args->filter;
 
     // Read HTTP request from the client
     char request[MAX_REQUEST_SIZE] = {0};
@@ -178,63 +58,34 @@ void handle_client(thread_args* args) {
 
     // Parse HTTP request and extract method, path, protocol, and host
     char method[16] = {0}, path[1024] = {0}, protocol[16] = {0}, host[MAX_HOST_SIZE] = {0};
-    if (sscanf(request, "%15s %1023s %15s\r\n", method, path, protocol) != 3) {
+    int parse_status = parseRequest(request, method, path, protocol, host);
+    if (parse_status == 400) {
         // Invalid request, send 400 Bad Request response
         displayErrorMessage(client_socket, 400, 0, 0);
         close(client_socket);
         free(args);
         return;
     }
-
-    // Pointer to the start of the request
-    char *request_ptr = request;
-    // Iterate through lines in the request
-    while ((request_ptr = strstr(request_ptr, "\n")) != NULL) {
-        // Move past the newline character
-        request_ptr++;
-        // Check if the line starts with "Host:"
-        if (strncmp(request_ptr, "Host:", 5) == 0) {
-            // Extract the host from the line
-            if (sscanf(request_ptr, "Host: %[^:\r\n]", host) != 1){
-                // Invalid request, send 400 Bad Request response
-                displayErrorMessage(client_socket, 400, 0, 0);
-                close(client_socket);
-                free(args);
-                return;
-            }
-            break;
-        }
-    }
-
-    // Check the http protocol version
-    if (strcmp(protocol, "HTTP/1.1") != 0 && strcmp(protocol, "HTTP/1.0") != 0){
-        displayErrorMessage(client_socket, 400, 0, 0);
-        close(client_socket);
-        free(args);
-        return;
-    }
-
-    // Check if host exists
-    if (strcmp(host, "") == 0){
-        displayErrorMessage(client_socket, 400, 0, 0);
+    else if (parse_status == 501) {
+        // Unsupported method, send 501 Not Implemented response
+        displayErrorMessage(client_socket, 501, 4, 4);
         close(client_socket);
         free(args);
         return;
     }
 
-    // Check if the method is GET
-    if (strcmp(method, "GET") != 0) {
-        // Unsupported method, send 501 Not Implemented response
-        displayErrorMessage(client_socket, 501, 4, 4);
+    // Check the host rules first, a blocked host doesn't need to be resolved
+    if (isHostFiltered(host, localFilter)) {
+        // Access denied, send 403 Forbidden response
+        displayErrorMessage(client_socket, 403, 1, 1);
         close(client_socket);
         free(args);
         return;
     }
 
     // Check if this host exist
-    struct hostent* host_info = gethostbyname(host);
-    if (host_info == NULL) {
-        herror("gethostbyname failed\n");
+    struct in_addr host_addr;
+    if (resolve_host(args->resolver, host, &host_addr) != 0) {
         // Unable to resolve host, send 404 Not Found response
         displayErrorMessage(client_socket, 404, 2, 2);
         close(client_socket);
@@ -242,26 +93,18 @@ void handle_client(thread_args* args) {
         return;
     }
 
-    // Convert host address to ip address to check with the filterFile
+    // Convert host address to ip address to check with the filter rules
     char ip[INET_ADDRSTRLEN] = {0};
-    inet_ntop(AF_INET, host_info->h_addr_list[0], ip, sizeof(ip));
+    inet_ntop(AF_INET, &host_addr, ip, sizeof(ip));
 
     // Check if the IP address matches any filter rule
-    int filtered = isFiltered(ip, host, localFilterFile);
-    if (filtered == 1) {
+    if (isFiltered(ip, host, localFilter)) {
         // Access denied, send 403 Forbidden response
         displayErrorMessage(client_socket, 403, 1, 1);
         close(client_socket);
         free(args);
         return;
     }
-    else if (filtered == 2){
-        // Server error, send 500 Some server error
-        displayErrorMessage(client_socket, 500, 3, 3);
-        close(client_socket);
-        free(args);
-        return;
-    }
 
     // Create a socket to connect with the server
     int server_sock = socket(AF_INET, SOCK_STREAM, 0);
@@ -281,7 +124,7 @@ void handle_client(thread_args* args) {
     // Set the type of the address to be IPv4
     sock_info.sin_family = AF_INET;
     // Set the socket's IP
-    sock_info.sin_addr = *((struct in_addr*)host_info->h_addr_list[0]);
+    sock_info.sin_addr = host_addr;
 
     // Connect to the server
     if (connect(server_sock, (struct sockaddr*) &sock_info, sizeof(sock_info)) < 0){
@@ -293,23 +136,8 @@ void handle_client(thread_args* args) {
         return;
     }
 
-    // Check if "Connection" header exists and update its value to "close" or add the header
-    char *connection_start = strstr(request, "Connection: keep-alive");
-    if (connection_start != NULL) {
-        // Pointer to what comes after "Connection: keep-alive"
-        char *content_after_connection = connection_start + strlen("Connection: keep-alive");
-        // Saving the content
-        char temp[1024] = {0};
-        strcpy(temp, content_after_connection);
-        // Replace "keep-alive" with "close"
-        strcpy(connection_start + 12, "close");
-        // Appending the modified content after "Connection: close"
-        strcat(request + 19, temp);
-    } else {
-        // Where "Connection: close" is not found, add it
-        char *connection_end = strstr(request, "\r\n\r\n");
-        strcpy(connection_end, "\r\nConnection: close\r\n\r\n");
-    }
+    // Make sure the server closes the connection after the response
+    setConnectionClose(request);
 
     // Ensure null terminator at the end
     size_t request_length = strlen(request);
@@ -345,8 +173,8 @@ void handle_client(thread_args* args) {
 // Main function
 int main(int argc, char* argv[]) {
     // Check for correct command line arguments
-    if (argc != 5) {
-        printf("Usage: proxyServer <port> <pool-size> <max-number-of-request> <filter>\n");
+    if (argc != 5 && argc != 6) {
+        printf("Usage: proxyServer <port> <pool-size> <max-number-of-request> <filter> [control-socket]\n");
         exit(1);
     }
 
@@ -356,9 +184,10 @@ int main(int argc, char* argv[]) {
     int max_requests = atoi(argv[3]);
     char filter[MAX_FILTER_SIZE] = {0};
     strcpy(filter, argv[4]);
+    const char *control_path = argc == 6 ? argv[5] : NULL;
 
     if (port <= 0 || port > 65535 || pool_size <= 0 || max_requests <= 0){
-        perror("Usage: proxyServer <port> <pool-size> <max-number-of-request> <filter>\n");
+        perror("Usage: proxyServer <port> <pool-size> <max-number-of-request> <filter> [control-socket]\n");
         exit(1);
     }
 
@@ -368,50 +197,114 @@ int main(int argc, char* argv[]) {
         exit(1);
     }
 
+    // Initialize the resolver cache
+    resolverCache* resolver = create_resolver_cache(RESOLVER_CACHE_SIZE);
+    if (resolver == NULL){
+        destroy_threadpool(pool);
+        exit(1);
+    }
+
     // Open the filter file
     FILE *filterFile = fopen(filter, "r");
     if (filterFile == NULL) {
         perror("Filter File open error\n");
         destroy_threadpool(pool);
+        destroy_resolver_cache(resolver);
         exit(1);
     }
 
-    // Set up a socket to listen for incoming connections
-    int server_socket = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_socket == -1) {
-        perror("Socket\n");
+    // Load the filter rules once, a new filter file is deployed with a hot restart
+    filterRules *rules = load_filter_rules(filterFile);
+    fclose(filterFile);
+    if (rules == NULL) {
         destroy_threadpool(pool);
-        fclose(filterFile);
+        destroy_resolver_cache(resolver);
         exit(1);
     }
 
-    struct sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(struct sockaddr_in));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(port);
-    server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    // Take over the listening socket and the resolver cache of a running proxy, if there is one
+    int server_socket = -1;
+    int taken_over = 0;
+    int control_socket = -1;
+    struct stat control_stat;
+    if (control_path != NULL) {
+        server_socket = hot_restart_takeover(control_path, resolver, &control_socket, &control_stat);
+        taken_over = server_socket != -1;
+    }
 
-    // Bind the socket to the specified port
-    if (bind(server_socket, (struct sockaddr*)&server_addr, sizeof(struct sockaddr_in)) == -1) {
-        perror("Bind\n");
-        close(server_socket);
-        destroy_threadpool(pool);
-        fclose(filterFile);
-        exit(1);
+    if (server_socket == -1) {
+        // Set up a socket to listen for incoming connections
+        server_socket = socket(AF_INET, SOCK_STREAM, 0);
+        if (server_socket == -1) {
+            perror("Socket\n");
+            destroy_threadpool(pool);
+            destroy_resolver_cache(resolver);
+            destroy_filter_rules(rules);
+            exit(1);
+        }
+
+        struct sockaddr_in server_addr;
+        memset(&server_addr, 0, sizeof(struct sockaddr_in));
+        server_addr.sin_family = AF_INET;
+        server_addr.sin_port = htons(port);
+        server_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+        // Bind the socket to the specified port
+        if (bind(server_socket, (struct sockaddr*)&server_addr, sizeof(struct sockaddr_in)) == -1) {
+            perror("Bind\n");
+            close(server_socket);
+            destroy_threadpool(pool);
+            destroy_resolver_cache(resolver);
+            destroy_filter_rules(rules);
+            exit(1);
+        }
+
+        // Listen for incoming connections
+        if (listen(server_socket, 10) == -1) {
+            perror("Listen\n");
+            close(server_socket);
+            destroy_threadpool(pool);
+            destroy_resolver_cache(resolver);
+            destroy_filter_rules(rules);
+            exit(1);
+        }
     }
 
-    // Listen for incoming connections
-    if (listen(server_socket, 10) == -1) {
-        perror("Listen\n");
-        close(server_socket);
-        destroy_threadpool(pool);
-        fclose(filterFile);
-        exit(1);
+    // Wait for the next process to take over from this one, a takeover already created the control socket
+    if (control_path != NULL && !taken_over) {
+        control_socket = hot_restart_listen(control_path, &control_stat);
+        if (control_socket == -1) {
+            close(server_socket);
+            destroy_threadpool(pool);
+            destroy_resolver_cache(resolver);
+            destroy_filter_rules(rules);
+            exit(1);
+        }
     }
 
     // Accept and handle incoming connections
     int num_requests = 0;
-    while (num_requests < max_requests) {
+    int handed_over = 0;
+    while (num_requests < max_requests && !handed_over) {
+        // Wait for either a client or a new process on the control socket
+        struct pollfd fds[2] = {{server_socket, POLLIN, 0}, {control_socket, POLLIN, 0}};
+        if (poll(fds, control_socket == -1 ? 1 : 2, -1) < 0) {
+            perror("poll\n");
+            continue;
+        }
+
+        // Once the new process accepts on the socket, stop accepting and drain the accepted jobs
+        if (fds[1].revents & POLLIN) {
+            if (hot_restart_handoff(control_socket, server_socket, resolver) == 0) {
+                handed_over = 1;
+            }
+            continue;
+        }
+
+        if (!(fds[0].revents & POLLIN)) {
+            continue;
+        }
+
         struct sockaddr_in client_addr;
         socklen_t client_len = sizeof(client_addr);
         int client_socket = accept(server_socket, (struct sockaddr*)&client_addr, &client_len);
@@ -430,15 +323,24 @@ int main(int argc, char* argv[]) {
         }
         args->client_socket = client_socket;
         args->port = port;
-        args->filterFile = filterFile;
+        args->filter = rules;
+        args->resolver = resolver;
 
         dispatch(pool, (dispatch_fn)handle_client, args);
 
         num_requests++;
     }
-    destroy_threadpool(pool);
+    if (control_socket != -1) {
+        close(control_socket);
+        // The control socket path belongs to the new process after a hand-over
+        if (!handed_over) {
+            hot_restart_unlink(control_path, &control_stat);
+        }
+    }
     close(server_socket);
-    fclose(filterFile);
+    destroy_threadpool(pool);
+    destroy_resolver_cache(resolver);
+    destroy_filter_rules(rules);
 
     return 0;
-}
\ No newline at end of file
+}
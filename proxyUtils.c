@@ -0,0 +1,135 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <time.h>
+#include "proxyUtils.h"
+
+size_t buildErrorMessage(char *buffer, size_t buffer_size, int error_num, int message, int status){
+    const char* errorMessages[5] = {
+            "Bad Request.",
+            "Access denied.",
+            "File not found.",
+            "Some server side error.",
+            "Method is not supported."
+    };
+
+    const char* statusMessages[5] = {
+            "Bad Request",
+            "Forbidden",
+            "Not Found",
+            "Internal Server Error",
+            "Not supported"
+    };
+
+    // Get the current time
+    time_t current_time;
+    time(&current_time);
+
+    // Format the time as shown in the files
+    char formatted_time[256] = {0};
+    struct tm time_info;
+    gmtime_r(&current_time, &time_info);
+    strftime(formatted_time, sizeof(formatted_time), "%a, %d %b %Y %H:%M:%S GMT", &time_info);
+
+    // Building the body of the response
+    char body[512] = {0};
+    snprintf(body, sizeof(body),
+             "<HTML><HEAD><TITLE>%d %s</TITLE></HEAD>\r\n<BODY><H4>%d %s</H4>\r\n%s\r\n</BODY></HTML>",
+             error_num, statusMessages[status], error_num, statusMessages[status], errorMessages[message]);
+
+    // Building the headers of the response
+    int content_length = strlen(body);
+    char header[1024] = {0};
+    snprintf(header, sizeof(header), "HTTP/1.1 %d %s\r\nServer: webserver/1.0\r\nDate: %s\r\n"
+                                     "Content-Type: text/html\r\nContent-Length: %d\r\nConnection: close",
+             error_num, statusMessages[status], formatted_time, content_length);
+
+    // Combine both strings
+    snprintf(buffer, buffer_size, "%s\r\n\r\n%s", header, body);
+    return strlen(buffer);
+}
+
+void displayErrorMessage(int client_socket, int error_num, int message, int status){
+    char error_response[MAX_REQUEST_SIZE] = {0};
+    size_t length = buildErrorMessage(error_response, sizeof(error_response), error_num, message, status);
+
+    // Send the error_response to the client
+    write(client_socket, error_response, length);
+}
+
+int parseRequest(const char *request, char *method, char *path, char *protocol, char *host){
+    // Parse the request line
+    if (sscanf(request, "%15s %1023s %15s\r\n", method, path, protocol) != 3) {
+        return 400;
+    }
+
+    // Pointer to the start of the request
+    const char *request_ptr = request;
+    // Iterate through lines in the request
+    while ((request_ptr = strstr(request_ptr, "\n")) != NULL) {
+        // Move past the newline character
+        request_ptr++;
+        // Check if the line starts with "Host:"
+        if (strncmp(request_ptr, "Host:", 5) == 0) {
+            // Extract the host from the line
+            if (sscanf(request_ptr, "Host: %1023[^:\r\n]", host) != 1){
+                return 400;
+            }
+            break;
+        }
+    }
+
+    // Check the http protocol version
+    if (strcmp(protocol, "HTTP/1.1") != 0 && strcmp(protocol, "HTTP/1.0") != 0){
+        return 400;
+    }
+
+    // Check if host exists
+    if (strcmp(host, "") == 0){
+        return 400;
+    }
+
+    // Check if the method is GET
+    if (strcmp(method, "GET") != 0) {
+        return 501;
+    }
+
+    return 0;
+}
+
+void setConnectionClose(char *request){
+    // Check if "Connection" header exists and update its value to "close" or add the header
+    char *connection_start = strstr(request, "Connection: keep-alive");
+    if (connection_start != NULL) {
+        // Pointer to what comes after "Connection: keep-alive"
+        char *content_after_connection = connection_start + strlen("Connection: keep-alive");
+        // Shift the content back over the 5 bytes freed by replacing "keep-alive" with "close"
+        memmove(connection_start + strlen("Connection: close"), content_after_connection,
+                strlen(content_after_connection) + 1);
+        memcpy(connection_start + 12, "close", 5);
+    } else {
+        // Where "Connection: close" is not found, add it
+        char *connection_end = strstr(request, "\r\n\r\n");
+        strcpy(connection_end, "\r\nConnection: close\r\n\r\n");
+    }
+}
+
+int receiveResponse(int server_sock, int client_sock){
+    unsigned char *response = (unsigned char *)malloc(1024);
+    while (1){
+        // Read the response from the server
+        ssize_t bytes_received = read(server_sock, response, 1024);
+        if (bytes_received <= 0) {
+            break;
+        }
+        // Write the response to the client
+        ssize_t bytes_written = write(client_sock, response, bytes_received);
+        if (bytes_written < 0) {
+            free(response);
+            return 1;
+        }
+    }
+    free(response);
+    return 0;
+}
@@ -0,0 +1,52 @@
+#ifndef PROXY_UTILS_H
+#define PROXY_UTILS_H
+
+#include <stddef.h>
+
+/**
+ * proxyUtils.h
+ *
+ * This file declares the request handling building blocks used by
+ * handle_client in proxyServer.c. They are kept apart from the server
+ * loop so that they can be linked and measured on their own (see proxyBench.c).
+ */
+
+#define MAX_REQUEST_SIZE 2048
+#define MAX_HOST_SIZE 1024
+
+
+/**
+ * buildErrorMessage formats a complete HTTP error response (headers and html body)
+ * into "buffer", which should be at least MAX_REQUEST_SIZE bytes.
+ * "message" and "status" are indexes into the error and status message tables.
+ * returns the length of the formatted response.
+ */
+size_t buildErrorMessage(char *buffer, size_t buffer_size, int error_num, int message, int status);
+
+/**
+ * displayErrorMessage builds the error response and writes it to the client socket.
+ */
+void displayErrorMessage(int client_socket, int error_num, int message, int status);
+
+/**
+ * parseRequest extracts the method, path, protocol and host of the request headers.
+ * the output buffers must be of 16, 1024, 16 and MAX_HOST_SIZE bytes.
+ * returns 0 if the request can be forwarded, else the HTTP error code
+ * to answer with (400 for a malformed request, 501 for an unsupported method).
+ */
+int parseRequest(const char *request, char *method, char *path, char *protocol, char *host);
+
+/**
+ * setConnectionClose rewrites "Connection: keep-alive" to "Connection: close",
+ * or adds the "Connection: close" header if there is none.
+ * "request" must hold full headers (ending with "\r\n\r\n") inside a MAX_REQUEST_SIZE buffer.
+ */
+void setConnectionClose(char *request);
+
+/**
+ * receiveResponse relays the server response to the client until the server closes.
+ * returns 0 on success, 1 if writing to the client failed.
+ */
+int receiveResponse(int server_sock, int client_sock);
+
+#endif //PROXY_UTILS_H
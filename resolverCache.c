@@ -0,0 +1,145 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include "resolverCache.h"
+
+// djb2 hash of the host name, used to pick its slot
+static unsigned long hash_host(const char* host) {
+    unsigned long hash = 5381;
+    for (const unsigned char* c = (const unsigned char*)host; *c != '\0'; ++c) {
+        hash = hash * 33 + *c;
+    }
+    return hash;
+}
+
+// Store an entry in its slot, replacing whatever was there. The lock must be held.
+static void store_entry(resolverCache* cache, const char* host, struct in_addr addr, time_t expires) {
+    resolver_entry* entry = &cache->entries[hash_host(host) % cache->capacity];
+    strncpy(entry->host, host, RESOLVER_HOST_SIZE - 1);
+    entry->host[RESOLVER_HOST_SIZE - 1] = '\0';
+    entry->addr = addr;
+    entry->expires = expires;
+}
+
+resolverCache* create_resolver_cache(int capacity) {
+    if (capacity <= 0) {
+        perror("Invalid resolver cache size\n");
+        return NULL;
+    }
+
+    resolverCache* cache = (resolverCache*)malloc(sizeof(resolverCache));
+    if (cache == NULL) {
+        perror("malloc\n");
+        return NULL;
+    }
+
+    // Allocate zeroed slots, an empty host marks a free slot
+    cache->entries = (resolver_entry*)calloc(capacity, sizeof(resolver_entry));
+    if (cache->entries == NULL) {
+        perror("calloc\n");
+        free(cache);
+        return NULL;
+    }
+    cache->capacity = capacity;
+
+    if (pthread_mutex_init(&cache->lock, NULL) != 0) {
+        perror("pthread_mutex_init\n");
+        free(cache->entries);
+        free(cache);
+        return NULL;
+    }
+
+    return cache;
+}
+
+int resolve_host(resolverCache* cache, const char* host, struct in_addr* addr) {
+    time_t now = time(NULL);
+
+    // Enter critical section
+    pthread_mutex_lock(&cache->lock);
+    resolver_entry* entry = &cache->entries[hash_host(host) % cache->capacity];
+    if (entry->expires > now && strcmp(entry->host, host) == 0) {
+        *addr = entry->addr;
+        pthread_mutex_unlock(&cache->lock);
+        return 0;
+    }
+    pthread_mutex_unlock(&cache->lock);
+    // Exit critical section
+
+    // Resolve without holding the lock, getaddrinfo is safe to call from several threads
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* result = NULL;
+    int error = getaddrinfo(host, NULL, &hints, &result);
+    if (error != 0) {
+        fprintf(stderr, "getaddrinfo failed: %s\n", gai_strerror(error));
+        return -1;
+    }
+    *addr = ((struct sockaddr_in*)result->ai_addr)->sin_addr;
+    freeaddrinfo(result);
+
+    pthread_mutex_lock(&cache->lock);
+    store_entry(cache, host, *addr, now + RESOLVER_TTL);
+    pthread_mutex_unlock(&cache->lock);
+
+    return 0;
+}
+
+int snapshot_resolver_cache(resolverCache* cache, resolver_entry** entries) {
+    time_t now = time(NULL);
+
+    // Enter critical section
+    pthread_mutex_lock(&cache->lock);
+
+    int count = 0;
+    for (int i = 0; i < cache->capacity; ++i) {
+        if (cache->entries[i].host[0] != '\0' && cache->entries[i].expires > now) {
+            count++;
+        }
+    }
+
+    // Allocate at least one entry so that an empty snapshot is not mistaken for a failure
+    *entries = (resolver_entry*)malloc((count > 0 ? count : 1) * sizeof(resolver_entry));
+    if (*entries == NULL) {
+        pthread_mutex_unlock(&cache->lock);
+        perror("malloc\n");
+        return -1;
+    }
+
+    int copied = 0;
+    for (int i = 0; i < cache->capacity && copied < count; ++i) {
+        if (cache->entries[i].host[0] != '\0' && cache->entries[i].expires > now) {
+            (*entries)[copied++] = cache->entries[i];
+        }
+    }
+
+    pthread_mutex_unlock(&cache->lock);
+    // Exit critical section
+
+    return copied;
+}
+
+void load_resolver_cache(resolverCache* cache, const resolver_entry* entries, int count) {
+    time_t now = time(NULL);
+
+    pthread_mutex_lock(&cache->lock);
+    for (int i = 0; i < count; ++i) {
+        // The snapshot comes from another process, don't let hash_host read past the host
+        if (entries[i].host[0] != '\0' && memchr(entries[i].host, '\0', RESOLVER_HOST_SIZE) != NULL &&
+            entries[i].expires > now) {
+            store_entry(cache, entries[i].host, entries[i].addr, entries[i].expires);
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+void destroy_resolver_cache(resolverCache* cache) {
+    pthread_mutex_destroy(&cache->lock);
+    free(cache->entries);
+    free(cache);
+}
@@ -0,0 +1,72 @@
+#ifndef RESOLVER_CACHE_H
+#define RESOLVER_CACHE_H
+
+#include <pthread.h>
+#include <time.h>
+#include <netinet/in.h>
+
+/**
+ * resolverCache.h
+ *
+ * This file declares a small cache of resolved host addresses shared by
+ * the worker threads, so that every request for a host does not go to DNS.
+ */
+
+// maximum length of a cached host name, same as MAX_HOST_SIZE of the proxy
+#define RESOLVER_HOST_SIZE 1024
+// number of seconds a resolved address is used before resolving it again
+#define RESOLVER_TTL 60
+
+
+/**
+ * a single resolved host
+ */
+typedef struct resolver_entry_st {
+    char host[RESOLVER_HOST_SIZE];  //host name, empty if the slot is free
+    struct in_addr addr;            //first IPv4 address of the host
+    time_t expires;                 //wall clock time the entry stops being valid
+} resolver_entry;
+
+
+/**
+ * The cache, a direct mapped table of entries indexed by the host hash
+ */
+typedef struct _resolver_cache_st {
+    int capacity;               //number of slots
+    resolver_entry* entries;    //the slots
+    pthread_mutex_t lock;       //lock on the slots
+} resolverCache;
+
+
+/**
+ * create_resolver_cache creates a cache with "capacity" slots.
+ * returns NULL on failure.
+ */
+resolverCache* create_resolver_cache(int capacity);
+
+/**
+ * resolve_host looks the host up in the cache, and resolves it on a miss
+ * or when the cached address expired.
+ * returns 0 and fills "addr" on success, -1 if the host can not be resolved.
+ */
+int resolve_host(resolverCache* cache, const char* host, struct in_addr* addr);
+
+/**
+ * snapshot_resolver_cache copies the entries that are still valid into
+ * a new array stored in "entries", which the caller must free.
+ * returns the number of entries copied, or -1 on failure.
+ */
+int snapshot_resolver_cache(resolverCache* cache, resolver_entry** entries);
+
+/**
+ * load_resolver_cache inserts the still valid entries of a snapshot into the cache.
+ * entries whose host is not null terminated are skipped.
+ */
+void load_resolver_cache(resolverCache* cache, const resolver_entry* entries, int count);
+
+/**
+ * destroy_resolver_cache frees all the memory associated with the cache.
+ */
+void destroy_resolver_cache(resolverCache* cache);
+
+#endif //RESOLVER_CACHE_H